@@ -8,8 +8,12 @@
 #include <boost/python/stl_iterator.hpp>
 #include <boost/iterator/iterator_facade.hpp>
 #include <boost/iterator/iterator_adaptor.hpp>
+#include <boost/unordered_set.hpp>
 #include <algorithm>
+#include <memory>
+#include <new>
 #include <utility>
+#include <vector>
 
 namespace pbr { namespace aux
 {
@@ -20,6 +24,21 @@ namespace pbr { namespace aux
   // mutable sequence, such as a list.
   using api::object_item;
 
+  // Set iteration uses _PySet_NextEntry, which is private CPython API.  It is
+  // available in the Python 2 series this library targets, and in Python 3
+  // up to 3.12.  Later versions no longer declare it, so set_iterator falls
+  // back to a Python iterator there.
+#if PY_VERSION_HEX < 0x030D0000
+  #define PBR_HAVE_PYSET_NEXTENTRY
+#endif
+
+  // The hash type reported by _PySet_NextEntry.
+#if PY_VERSION_HEX >= 0x03020000
+  typedef Py_hash_t hash_t;
+#else
+  typedef long hash_t;
+#endif
+
   struct range_base
   {
     range_base(object obj)
@@ -197,6 +216,83 @@ namespace pbr { namespace aux
     object m_iteritems; // iterator used to observe the Python mappable
     tuple m_pos; // key/value pair
   };
+
+  // Set
+  //
+  // Iterates a set or frozenset by walking its hash table directly with
+  // _PySet_NextEntry, so no Python iterator object is created.  The position
+  // is an index into the table, and the current key is borrowed from the set.
+  // Where _PySet_NextEntry is unavailable, a Python iterator is used instead
+  // and the current key is owned by the iterator.  Like the mapping iterator,
+  // this pre-increments in the constructor and becomes an end iterator when
+  // the set is exhausted.  The set must not be modified while it is being
+  // iterated.
+  template<typename Value>
+  struct set_iterator
+    : boost::iterator_facade<
+          set_iterator<Value>
+        , Value
+        , boost::incrementable_traversal_tag
+        , Value
+        >
+  {
+    set_iterator()
+      : set_iterator::iterator_facade_(), m_obj(), m_pos(0), m_key(0)
+    {
+    }
+    set_iterator(range_base const & range, bool end)
+      : set_iterator::iterator_facade_(), m_obj(), m_pos(0), m_key(0)
+    {
+      if(end)
+        return;
+#ifdef PBR_HAVE_PYSET_NEXTENTRY
+      m_obj = range.m_obj;
+#else
+      m_obj = object(handle<>(PyObject_GetIter(range.m_obj.ptr())));
+#endif
+      this->increment();
+    }
+  private:
+    // facade interface
+    friend class boost::iterator_core_access;
+    typename set_iterator::iterator_facade_::reference
+    dereference() const
+    {
+      return extract<Value>(object(handle<>(borrowed(m_key))));
+    }
+    void increment()
+    {
+#ifdef PBR_HAVE_PYSET_NEXTENTRY
+      PyObject * key;
+      hash_t hash;
+      if(_PySet_NextEntry(m_obj.ptr(), &m_pos, &key, &hash))
+        m_key = key;
+      else
+        *this = set_iterator();
+#else
+      PyObject * key = PyIter_Next(m_obj.ptr());
+      if(key)
+      {
+        m_item = object(handle<>(key));
+        m_key = key;
+      }
+      else if(PyErr_Occurred())
+        throw_error_already_set();
+      else
+        *this = set_iterator();
+#endif
+    }
+    template<typename Y>
+      bool equal(Y y) const { return m_key == y.m_key; }
+
+    // data
+    object m_obj; // the set, or an iterator over it
+    Py_ssize_t m_pos; // position in the set's hash table
+    PyObject * m_key; // current key; null at the end
+#ifndef PBR_HAVE_PYSET_NEXTENTRY
+    object m_item; // owns the current key
+#endif
+  };
 }}
 
 namespace pbr
@@ -281,6 +377,283 @@ namespace pbr
       return const_iterator(this->m_obj, true);
     }
   };
+
+  // --- set_range ---
+  // Accepts a set or frozenset.
+  template<typename Value = aux::object>
+  class set_range
+    : aux::range_base
+  {
+  public:
+    typedef Value value_type;
+    typedef aux::set_iterator<Value> iterator;
+    typedef iterator const_iterator;
+    set_range(aux::object const & obj)
+      : aux::range_base(obj)
+    {
+      if(!PyAnySet_Check(m_obj.ptr()))
+        throw bad_range("set_range");
+    }
+    const_iterator begin() const
+    {
+      return const_iterator(this->m_obj, false);
+    }
+    const_iterator end() const
+    {
+      return const_iterator(this->m_obj, true);
+    }
+    std::size_t size() const { return PySet_Size(m_obj.ptr()); }
+    // Membership test performed by Python.  Requires the GIL.
+    bool contains(aux::object const & key) const
+    {
+      int const result = PySet_Contains(m_obj.ptr(), key.ptr());
+      if(result < 0) aux::throw_error_already_set();
+      return result;
+    }
+  };
+
+  // --- set_index ---
+  // A native copy of the keys of a Python set, for membership tests that do
+  // not touch Python.  Building the index requires the GIL; after that,
+  // contains() may be called without it.  The index is a snapshot, so later
+  // changes to the set are not seen.  Key must be hashable by boost::hash,
+  // e.g., int or std::string.
+  template<typename Key>
+  class set_index
+  {
+    typedef boost::unordered_set<Key> table_type;
+  public:
+    typedef Key key_type;
+    typedef typename table_type::const_iterator iterator;
+    typedef iterator const_iterator;
+    set_index(set_range<Key> const & range)
+      : m_table(range.begin(), range.end())
+    {
+    }
+    set_index(aux::object const & obj)
+      : m_table()
+    {
+      set_range<Key> const range(obj);
+      m_table.insert(range.begin(), range.end());
+    }
+    bool contains(Key const & key) const
+    {
+      return m_table.find(key) != m_table.end();
+    }
+    std::size_t size() const { return m_table.size(); }
+    const_iterator begin() const { return m_table.begin(); }
+    const_iterator end() const { return m_table.end(); }
+  private:
+    table_type m_table;
+  };
+
+  // --- packed_matrix ---
+  // A dense copy of a matrix in one aligned buffer, laid out in row-major or
+  // column-major order.  data() and leading_dimension() describe the buffer
+  // in the form expected by BLAS-style kernels.  Produced by
+  // matrix_range::pack().
+  enum storage_order { row_major, column_major };
+
+  template<typename Value>
+  class packed_matrix
+  {
+  public:
+    typedef Value value_type;
+    static std::size_t const alignment = 64;
+
+    packed_matrix(std::size_t rows, std::size_t cols, storage_order order)
+      : m_rows(rows), m_cols(cols), m_order(order), m_storage(0), m_data(0)
+    {
+      this->allocate();
+    }
+    packed_matrix(packed_matrix const & other)
+      : m_rows(other.m_rows), m_cols(other.m_cols), m_order(other.m_order)
+      , m_storage(0), m_data(0)
+    {
+      this->allocate();
+      std::copy(other.m_data, other.m_data + this->size(), m_data);
+    }
+    packed_matrix & operator=(packed_matrix const & other)
+    {
+      if(this != &other)
+      {
+        packed_matrix tmp(other);
+        this->swap(tmp);
+      }
+      return *this;
+    }
+    ~packed_matrix() { this->deallocate(); }
+
+    std::size_t rows() const { return m_rows; }
+    std::size_t cols() const { return m_cols; }
+    std::size_t size() const { return m_rows * m_cols; }
+    storage_order order() const { return m_order; }
+    std::size_t leading_dimension() const
+    {
+      return m_order == row_major ? m_cols : m_rows;
+    }
+    Value * data() { return m_data; }
+    Value const * data() const { return m_data; }
+    Value & operator()(std::size_t i, std::size_t j)
+    {
+      return m_data[this->offset(i, j)];
+    }
+    Value const & operator()(std::size_t i, std::size_t j) const
+    {
+      return m_data[this->offset(i, j)];
+    }
+    void swap(packed_matrix & other)
+    {
+      std::swap(m_rows, other.m_rows);
+      std::swap(m_cols, other.m_cols);
+      std::swap(m_order, other.m_order);
+      std::swap(m_storage, other.m_storage);
+      std::swap(m_data, other.m_data);
+    }
+  private:
+    std::size_t offset(std::size_t i, std::size_t j) const
+    {
+      return m_order == row_major ? i * m_cols + j : j * m_rows + i;
+    }
+    // Over-allocate raw storage, then construct the elements at the first
+    // aligned address within it.
+    void allocate()
+    {
+      m_storage = static_cast<char *>(
+          ::operator new(this->size() * sizeof(Value) + alignment)
+        );
+      std::size_t const addr = reinterpret_cast<std::size_t>(m_storage);
+      m_data = reinterpret_cast<Value *>(
+          (addr + alignment - 1) / alignment * alignment
+        );
+      try { std::uninitialized_fill_n(m_data, this->size(), Value()); }
+      catch(...)
+      {
+        ::operator delete(m_storage);
+        throw;
+      }
+    }
+    void deallocate()
+    {
+      for(std::size_t k = 0; k < this->size(); ++k)
+        m_data[k].~Value();
+      ::operator delete(m_storage);
+    }
+
+    // data
+    std::size_t m_rows;
+    std::size_t m_cols;
+    storage_order m_order;
+    char * m_storage; // owned raw allocation
+    Value * m_data; // aligned elements within m_storage
+  };
+
+  // --- matrix_range ---
+  // Accepts a sequence of equal-length sequences, such as a list of lists.
+  // Strings are not accepted as rows.  The shape is validated once, on
+  // construction, and the rows are cached so that element access costs a
+  // single item lookup.  Rows that are exactly lists or tuples are read
+  // directly; other sequences are read through a list copied on construction.
+  // The shape of the Python object must not change while the range is in
+  // use.  Indices are not checked.
+  template<typename Value = aux::object>
+  class matrix_range
+    : aux::range_base
+  {
+  public:
+    typedef Value value_type;
+    typedef packed_matrix<Value> packed_type;
+    matrix_range(aux::object const & obj)
+      : aux::range_base(obj), m_rows(), m_fast(), m_cols(0)
+    {
+      if(!PySequence_Check(m_obj.ptr()))
+        throw bad_range("matrix_range");
+      aux::ssize_t const rows = aux::len(m_obj);
+      m_rows.reserve(rows);
+      m_fast.reserve(rows);
+      for(aux::ssize_t i = 0; i < rows; ++i)
+      {
+        aux::object const row = m_obj[i];
+        if(!PySequence_Check(row.ptr())
+            || PyBytes_Check(row.ptr()) || PyUnicode_Check(row.ptr())
+          )
+          throw bad_range("matrix_range");
+        // For exact lists and tuples, this returns the row itself.
+        PyObject * fast = PySequence_Fast(row.ptr(), "");
+        if(!fast)
+        {
+          PyErr_Clear();
+          throw bad_range("matrix_range");
+        }
+        m_rows.push_back(row);
+        m_fast.push_back(aux::object(aux::handle<>(fast)));
+        std::size_t const cols = PySequence_Fast_GET_SIZE(fast);
+        if(i == 0)
+          m_cols = cols;
+        else if(cols != m_cols)
+          throw bad_range("matrix_range: ragged rows");
+      }
+    }
+    std::size_t rows() const { return m_rows.size(); }
+    std::size_t cols() const { return m_cols; }
+    Value operator()(std::size_t i, std::size_t j) const
+    {
+      return aux::extract<Value>(
+          aux::object(aux::handle<>(aux::borrowed(this->item(i, j))))
+        );
+    }
+    // Copy the elements into a packed buffer.
+    packed_type pack(storage_order order = row_major) const
+    {
+      packed_type packed(this->rows(), m_cols, order);
+      for(std::size_t i = 0; i < this->rows(); ++i)
+        for(std::size_t j = 0; j < m_cols; ++j)
+          packed(i, j) = (*this)(i, j);
+      return packed;
+    }
+    // Write the elements of a packed buffer back to the Python object.  Every
+    // row must support item assignment; this is checked before anything is
+    // written, and bad_range is thrown otherwise.  If Python rejects an
+    // individual element (e.g., a float stored into an integer array), the
+    // error is raised and the object is left partially written.
+    void unpack(packed_type const & packed)
+    {
+      if(packed.rows() != this->rows() || packed.cols() != m_cols)
+        throw bad_range("matrix_range::unpack: shape mismatch");
+      for(std::size_t i = 0; i < this->rows(); ++i)
+      {
+        PySequenceMethods const * methods =
+            Py_TYPE(m_rows[i].ptr())->tp_as_sequence;
+        if(!methods || !methods->sq_ass_item)
+          throw bad_range("matrix_range::unpack: row is not writable");
+      }
+      for(std::size_t i = 0; i < this->rows(); ++i)
+      {
+        bool const copied = m_fast[i].ptr() != m_rows[i].ptr();
+        for(std::size_t j = 0; j < m_cols; ++j)
+        {
+          aux::object const value(packed(i, j));
+          if(PySequence_SetItem(m_rows[i].ptr(), j, value.ptr()) < 0)
+            aux::throw_error_already_set();
+          // Keep the copy used for reading up to date.
+          if(copied
+              && PySequence_SetItem(m_fast[i].ptr(), j, value.ptr()) < 0
+            )
+            aux::throw_error_already_set();
+        }
+      }
+    }
+  private:
+    PyObject * item(std::size_t i, std::size_t j) const
+    {
+      return PySequence_Fast_GET_ITEM(m_fast[i].ptr(), j);
+    }
+
+    // data
+    std::vector<aux::object> m_rows; // the original rows
+    std::vector<aux::object> m_fast; // each row, or a list copy of it
+    std::size_t m_cols;
+  };
 }
 
 // Overload std::swap and std::iter_swap for Python objects.
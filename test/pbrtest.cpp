@@ -14,7 +14,9 @@
 #include <boost/preprocessor/stringize.hpp>
 #include <iostream>
 #include <string>
+#include <vector>
 #include <algorithm>
+#include <stdexcept>
 
 #define foreach BOOST_FOREACH
 
@@ -58,6 +60,77 @@ void shuffle_sequence(object seq)
   boost::random_shuffle(range);
 }
 
+// Count the keys that are members of a set, using a native index.  The keys
+// are copied out of Python first, so the lookups run without the GIL.
+template<typename Key>
+int count_members_indexed(object set, object keys)
+{
+  pbr::set_index<Key> const index((pbr::set_range<Key>(set)));
+  pbr::random_access_range<Key> const range(keys);
+  std::vector<Key> const native(boost::begin(range), boost::end(range));
+  int num = 0;
+  Py_BEGIN_ALLOW_THREADS
+  for(std::size_t i = 0; i < native.size(); ++i)
+  {
+    if(index.contains(native[i])) ++num;
+  }
+  Py_END_ALLOW_THREADS
+  return num;
+}
+
+// Return the number of keys in a native index of a set.
+template<typename Key>
+int index_size(object set)
+{
+  pbr::set_index<Key> const index(set);
+  return index.size();
+}
+
+// Count the keys that are members of a set, using Python.
+int count_members(object set, object keys)
+{
+  int num = 0;
+  pbr::set_range<> const range(set);
+  foreach(object key, pbr::random_access_range<>(keys))
+  {
+    if(range.contains(key)) ++num;
+  }
+  return num;
+}
+
+// Return the shape of a matrix of numbers as a (rows, cols) tuple.
+tuple matrix_shape(object seq)
+{
+  pbr::matrix_range<double> const matrix(seq);
+  return make_tuple(matrix.rows(), matrix.cols());
+}
+
+// Sum the elements of a matrix, accessing them in place.
+double matrix_sum(object seq)
+{
+  pbr::matrix_range<double> const matrix(seq);
+  double sum = 0;
+  for(std::size_t i = 0; i < matrix.rows(); ++i)
+    for(std::size_t j = 0; j < matrix.cols(); ++j)
+      sum += matrix(i, j);
+  return sum;
+}
+
+// Multiply each element of a matrix by its linear position in the packed
+// buffer, then write the result back.  Exercises both storage orders.
+void scale_matrix_by_position(object seq, bool column_major)
+{
+  typedef pbr::matrix_range<double> range_type;
+  range_type matrix(seq);
+  range_type::packed_type packed =
+      matrix.pack(column_major ? pbr::column_major : pbr::row_major);
+  if(reinterpret_cast<std::size_t>(packed.data()) % packed.alignment != 0)
+    throw std::runtime_error("packed buffer is misaligned");
+  for(std::size_t k = 0; k < packed.size(); ++k)
+    packed.data()[k] *= k;
+  matrix.unpack(packed);
+}
+
 // THIS FUNCTION FAILS
 void heap_func(object seq, object func)
 {
@@ -115,6 +188,24 @@ BOOST_PYTHON_MODULE(pbrtest)
   #undef PBR_def
   #undef PBR_def2
 
+  // const set
+  // Make a function count_set_<type> for each type in the above list.
+  #define PBR_def(r, data, tp) \
+      def(                   \
+          "count_set_" BOOST_PP_STRINGIZE(tp) \
+        , count<pbr::set_range<tp> >          \
+        , ""                 \
+        );
+  BOOST_PP_SEQ_FOR_EACH(PBR_def,,PBR_py_types)
+  #undef PBR_def
+
+  def("count_members", count_members, "");
+  def("count_members_indexed_int", count_members_indexed<int>, "");
+  def("count_members_indexed_string", count_members_indexed<std::string>, "");
+  def("index_size_int", index_size<int>, "");
+  def("matrix_shape", matrix_shape, "");
+  def("matrix_sum", matrix_sum, "");
+  def("scale_matrix_by_position", scale_matrix_by_position, "");
   def("increment_sequence", increment_sequence, "");
   def("double_sequence", double_sequence, "");
   def("shuffle_sequence", shuffle_sequence, "");
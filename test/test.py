@@ -3,6 +3,7 @@
 # Copyright (c) 2011 Andy Jost
 # Please see the file LICENSE.txt in this distribution for license terms.
 
+import array
 import copy
 import pbrtest
 import unittest
@@ -26,6 +27,14 @@ class PbrTest(unittest.TestCase):
     MAPS[(tuple,str)] = {(1,1):'11', (1,2):'12', (2,1):'21', (2,2):'22'}
     self.MAPS = MAPS
 
+    SETS = {}
+    SETS[(set,object)] = set(['a', 5, (1,2)])
+    SETS[(set,int)] = set(range(10))
+    SETS[(set,str)] = set(['a', 'b', 'c', 'd', 'e'])
+    SETS[(frozenset,int)] = frozenset(range(10))
+    SETS[(frozenset,tuple)] = frozenset([(1,1), (1,2), (2,1)])
+    self.SETS = SETS
+
   def testBasic(self):
     """
     These basic tests simply check whether the C++ code can iterate over the
@@ -57,6 +66,15 @@ class PbrTest(unittest.TestCase):
     self._check(pbrtest.count_mapping_int_list, self.MAPS, int, list)
     self._check(pbrtest.count_mapping_tuple_str, self.MAPS, tuple, str)
 
+    # set
+    self._check(pbrtest.count_set_object, self.SETS, object, object)
+    self._check(pbrtest.count_set_int, self.SETS, object, int)
+    self._check(pbrtest.count_set_str, self.SETS, object, str)
+    self._check(pbrtest.count_set_tuple, self.SETS, object, tuple)
+    self._check(pbrtest.count_set_list, self.SETS, object, list)
+    self.assertRaises(Exception, lambda: pbrtest.count_set_int(range(10)))
+    self.assertRaises(Exception, lambda: pbrtest.count_set_object({1:2}))
+
   # Check each sequence in SEQUENCES.  For ones whose element type matches "type,"
   # call the function and confirm that it correctly iterates over the sequence.
   # For others, confirm that the iteration fails.
@@ -120,6 +138,72 @@ class PbrTest(unittest.TestCase):
     self.assertTrue(input != range(100))
     self.assertTrue(sorted(input) == range(100))
 
+  def testSetMembership(self):
+    """
+    Test membership in sets, both through Python and through a native index.
+    """
+    ints = set(range(0, 100, 2))
+    keys = range(100)
+    self.assertTrue(pbrtest.count_members(ints, keys) == 50)
+    self.assertTrue(pbrtest.count_members_indexed_int(ints, keys) == 50)
+    self.assertTrue(pbrtest.count_members_indexed_int(frozenset(ints), keys) == 50)
+    self.assertTrue(pbrtest.count_members_indexed_int(set(), keys) == 0)
+    self.assertTrue(pbrtest.index_size_int(ints) == 50)
+    self.assertTrue(pbrtest.index_size_int(frozenset()) == 0)
+
+    strs = frozenset(['a', 'b', 'c'])
+    self.assertTrue(pbrtest.count_members(strs, ['a', 'c', 'x']) == 2)
+    self.assertTrue(pbrtest.count_members_indexed_string(strs, ['a', 'c', 'x']) == 2)
+
+    # Unhashable keys raise an error; mistyped sets cannot be indexed.
+    self.assertRaises(Exception, lambda: pbrtest.count_members(ints, [[]]))
+    self.assertRaises(Exception, lambda: pbrtest.count_members_indexed_int(strs, keys))
+
+  def testMatrix(self):
+    """
+    Access nested sequences as matrices, and pack them into buffers.
+    """
+    m = [[1, 2, 3], [4, 5, 6]]
+    self.assertTrue(pbrtest.matrix_shape(m) == (2, 3))
+    self.assertTrue(pbrtest.matrix_shape(((1.5,), (2.5,))) == (2, 1))
+    self.assertTrue(pbrtest.matrix_shape([]) == (0, 0))
+    self.assertTrue(pbrtest.matrix_sum(m) == 21)
+
+    # Ragged, non-nested, and mistyped inputs are rejected.
+    self.assertRaises(Exception, lambda: pbrtest.matrix_shape([[1, 2], [3]]))
+    self.assertRaises(Exception, lambda: pbrtest.matrix_shape([1, 2]))
+    self.assertRaises(Exception, lambda: pbrtest.matrix_sum([['a', 'b']]))
+
+    # Row-major and column-major packing, written back in place.
+    pbrtest.scale_matrix_by_position(m, False)
+    self.assertTrue(m == [[0, 2, 6], [12, 20, 30]])
+    m = [[1, 2, 3], [4, 5, 6]]
+    pbrtest.scale_matrix_by_position(m, True)
+    self.assertTrue(m == [[0, 4, 12], [4, 15, 30]])
+
+    # Rows that are neither lists nor tuples are written back in place.
+    class MyList(list): pass
+    m = [MyList([1, 2]), array.array('d', [3, 4])]
+    pbrtest.scale_matrix_by_position(m, False)
+    self.assertTrue(m == [MyList([0, 2]), array.array('d', [6, 12])])
+    self.assertTrue(type(m[0]) is MyList)
+
+    # Writing back requires mutable rows, and nothing is written otherwise.
+    m = [[1., 2.], (3., 4.)]
+    self.assertRaises(Exception,
+        lambda: pbrtest.scale_matrix_by_position(m, False))
+    self.assertTrue(m == [[1., 2.], (3., 4.)])
+
+    # An element Python rejects raises an error, possibly after earlier rows
+    # have been written.
+    m = [[1., 2.], array.array('i', [3, 4])]
+    self.assertRaises(Exception,
+        lambda: pbrtest.scale_matrix_by_position(m, False))
+    self.assertTrue(m[1] == array.array('i', [3, 4]))
+
+    # String rows are rejected.
+    self.assertRaises(Exception, lambda: pbrtest.matrix_shape(['ab', 'cd']))
+
 if __name__ == '__main__':
   unittest.main()
     